@@ -36,8 +36,29 @@ static const elem_t POISON = __INT_MAX__;
 // Canary value to protect data.
 static const canary_t CANARY_VALUE = 0xBAADF00D;
 
+// Type of the stack size and capacity.
+typedef long long stack_size_t;
+
+// Format specifier for printf() to print the stack size and capacity.
+#define STACK_SIZE_FORMAT "%lld"
+
 // Default minimum capacity that the stack can have.
-static const int STACK_SIZE_DEFAULT = 16;
+static const stack_size_t STACK_SIZE_DEFAULT = 16;
 
 // Multiplier by which the capacity of the stack will be increased when needed.
-static const float STACK_CAPACITY_MULTIPLIER = 2.0;
\ No newline at end of file
+static const stack_size_t STACK_CAPACITY_MULTIPLIER = 2;
+
+// Number of elements in one segment written to the spill file.
+static const stack_size_t STACK_SPILL_SEGMENT_SIZE = 1 << 16;
+
+// Number of elements copied from the data shared with the forks at once.
+static const stack_size_t STACK_FORK_SEGMENT_SIZE = 1024;
+
+// Amount of operations on other stacks after which the stack is considered idle.
+static const unsigned long long STACK_IDLE_OPERATIONS = 1024;
+
+// Default capacity of the record stack in bytes.
+static const stack_size_t RECORD_STACK_CAPACITY_DEFAULT = 256;
+
+// Poison value for unused bytes of the record stack.
+static const unsigned char RECORD_POISON = 0xDD;
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef RECORD_STACK_H
+#define RECORD_STACK_H
+
+#include "stack.h"
+
+/**
+ * @struct
+ * @brief Stack of variable-length byte records.
+ *
+ * The records are stored one after another in a single buffer,
+ * each followed by its length of type `stack_size_t`.
+*/
+struct RecordStack
+{
+    #ifdef CANARY_PROTECT
+    canary_t leftCanary;
+    #endif
+
+    char* data;            ///< Records with their lengths.
+    stack_size_t size;     ///< Amount of used bytes.
+    stack_size_t capacity; ///< Amount of allocated bytes.
+    stack_size_t count;    ///< Amount of records.
+    StackBudget* budget;   ///< Memory accounting entry.
+    StackInitInfo info; ///< Stack initialization info.
+
+    #ifdef HASH_PROTECT
+    unsigned long long dataHash;
+    unsigned long long structHash;
+    #endif
+
+    #ifdef CANARY_PROTECT
+    canary_t rightCanary;
+    #endif
+};
+
+
+/**
+ * @brief Dumps the record stack, called by `stackDump`.
+*/
+void stackDump_internal(const RecordStack* stk, const StackError err,
+               const char* fileName, const size_t line, const char* funcName);
+
+
+/**
+ * @brief Initializes a record stack structure.
+ *
+ * @param[out] stk Record stack struct.
+ *
+ * @return Error code.
+ *
+ * @note Don't forget to call `recordStackDtor` when you're done to free the allocated memory.
+ * @note The stack struct owns its entry in the memory accounting. Don't copy or move
+ *       the struct, and call `recordStackDtor` before it goes out of scope to not leak the memory.
+ */
+#define recordStackInit(stk) recordStackInit_internal((stk), StackInitInfo{__FILE__, #stk, __FUNCTION__, __LINE__})
+
+StackError recordStackInit_internal(RecordStack* stk, StackInitInfo info);
+StackError recordStackInit_internal(RecordStack* stk, size_t capacity, StackInitInfo info);
+
+
+/**
+ * @brief Copies the record on top of the stack, allocating more memory if needed.
+ *
+ * @param[out] stk        The record stack
+ * @param[in]  record     The record bytes
+ * @param[in]  recordSize Amount of bytes in the record
+ *
+ * @return Error code.
+*/
+StackError recordStackPush(RecordStack* stk, const void* record, size_t recordSize);
+
+
+/**
+ * @brief Removes the top record from the stack, copying it to the buffer.
+ *
+ * @param[out] stk        The record stack
+ * @param[out] buffer     The buffer for the record
+ * @param[in]  bufferSize Size of the buffer
+ * @param[out] recordSize Amount of bytes in the record
+ *
+ * @return Error code.
+ *
+ * @note If the buffer is too small, the record stays on the stack,
+ *       `recordSize` is set and `RECORD_BUFFER_SIZE_ERROR` is returned.
+*/
+StackError recordStackPop(RecordStack* stk, void* buffer, size_t bufferSize, size_t* recordSize);
+
+
+/**
+ * @brief Gets the top record without copying it.
+ *
+ * @param[in]  stk        The record stack
+ * @param[out] record     Pointer to the record bytes
+ * @param[out] recordSize Amount of bytes in the record
+ *
+ * @return Error code.
+ *
+ * @note The pointer is valid until the next push or pop.
+*/
+StackError recordStackPeek(RecordStack* stk, const void** record, size_t* recordSize);
+
+
+/**
+ * @brief Destructor for record stack structure.
+ *
+ * @param[in] stk Record stack struct.
+ *
+ * @return Error code.
+*/
+StackError recordStackDtor(RecordStack* stk);
+
+#endif
@@ -25,6 +25,12 @@
         func(DEAD_DATA_CANARY_ERROR)\
         func(UNREGISTERED_STRUCT_ACCESS_ERROR)\
         func(UNREGISTERED_DATA_ACCESS_ERROR)\
+        func(SPILL_WRITE_ERROR)\
+        func(SPILL_READ_ERROR)\
+        func(RECORD_BUFFER_SIZE_ERROR)\
+        func(MEMORY_LIMIT_ERROR)\
+        func(FORK_SPILLED_ERROR)\
+        func(STRUCT_MOVED_ERROR)\
 
 #define GENERATE_ENUM(ENUM) ENUM,
 #define GENERATE_STRING(STRING) #STRING,
@@ -43,6 +49,12 @@
 // DEAD_DATA_CANARY_ERROR,           < Data canary value indicates a possible stack attack.
 // UNREGISTERED_STRUCT_ACCESS_ERROR, < Struct hash mismatch due to unauthorized data manipulation.
 // UNREGISTERED_DATA_ACCESS_ERROR,   < Data hash mismatch due to unauthorized data manipulation.
+// SPILL_WRITE_ERROR,                < Failed to write a segment to the spill file.
+// SPILL_READ_ERROR,                 < Failed to read a segment from the spill file.
+// RECORD_BUFFER_SIZE_ERROR,         < Buffer is too small for the popped record.
+// MEMORY_LIMIT_ERROR,               < Memory of all the stacks would exceed the hard limit.
+// FORK_SPILLED_ERROR,               < Stack with spilled elements can't be forked.
+// STRUCT_MOVED_ERROR,               < Stack struct was copied or moved after initialization.
 
 /**
  * @brief Error codes returned by stack functions.
@@ -63,6 +75,9 @@ struct StackInitInfo
     int lineNum;
 };
 
+struct StackSpill;
+struct StackShared;
+struct StackBudget;
 
 
 /**
@@ -75,9 +90,15 @@ struct Stack
     canary_t leftCanary;
     #endif
     
-    elem_t* data; ///< Data array.
-    int size;     ///< Current stack index.
-    int capacity; ///< Current max size of the stack.
+    elem_t* data;               ///< Data array.
+    stack_size_t size;          ///< Current stack index.
+    stack_size_t capacity;      ///< Current max size of the stack.
+    StackSpill* spill;          ///< Spill file state, NULL if spilling is disabled.
+    stack_size_t spilledSize;   ///< Amount of bottom elements written to the spill file.
+    stack_size_t spillCapacity; ///< Max capacity of the stack when spilling is enabled.
+    StackShared* base;          ///< Elements below the data shared with the forks, NULL if none.
+    stack_size_t baseSize;      ///< Amount of elements of the base used by the stack.
+    StackBudget* budget;        ///< Memory accounting entry.
     StackInitInfo info; ///< Stack initialization info.
 
     #ifdef HASH_PROTECT
@@ -117,6 +138,8 @@ void stackDump_internal(const Stack* stk, const StackError err,
  * @return Error code.
  * 
  * @note Don't forget to call `stackDtor` when you're done to free the allocated memory.
+ * @note The stack struct owns its entry in the memory accounting. Don't copy or move
+ *       the struct, and call `stackDtor` before it goes out of scope to not leak the memory.
  */
 #define stackInit(stk) stackInit_internal((stk), StackInitInfo{__FILE__, #stk, __FUNCTION__, __LINE__})
 
@@ -146,6 +169,35 @@ StackError stackPush(Stack* stk, const elem_t elem);
 StackError stackPop(Stack* stk, elem_t* elem);
 
 
+/**
+ * @brief Enables writing the cold bottom of the stack to a temporary file.
+ * 
+ * @param[out] stk          The stack
+ * @param[in]  memoryBudget Max amount of bytes the stack data can take in memory.
+ * 
+ * @return Error code.
+ * 
+ * @note The budget is rounded to `STACK_SPILL_SEGMENT_SIZE` elements and can't be less than two segments.
+*/
+StackError stackEnableSpill(Stack* stk, size_t memoryBudget);
+
+
+/**
+ * @brief Makes a copy of the stack in constant time.
+ * 
+ * @param[out] stk  The stack
+ * @param[out] fork The copy
+ * 
+ * @return Error code.
+ * 
+ * @note Both stacks share the current elements, which are copied by segments only when popped.
+ * @note Don't forget to call `stackDtor` for both stacks when you're done.
+*/
+#define stackFork(stk, fork) stackFork_internal((stk), (fork), StackInitInfo{__FILE__, #fork, __FUNCTION__, __LINE__})
+
+StackError stackFork_internal(Stack* stk, Stack* fork, StackInitInfo info);
+
+
 /**
  * @brief Destructor for stack structure.
  * 
@@ -155,12 +207,32 @@ StackError stackPop(Stack* stk, elem_t* elem);
 */
 StackError stackDtor(Stack* stk);
 
+/**
+ * @brief Sets the limits for the memory taken by the data of all the stacks.
+ * 
+ * @param[in] softLimit Amount of bytes after which idle stacks are shrunk, 0 for no limit.
+ * @param[in] hardLimit Amount of bytes the stacks can't grow past, 0 for no limit.
+ * 
+ * @note Growth past the hard limit fails with `MEMORY_LIMIT_ERROR`.
+ * @note The memory accounting is guarded by a mutex, so different stacks can be used
+ *       from different threads. One stack can't be used from several threads at once.
+*/
+void setStackMemoryLimits(size_t softLimit, size_t hardLimit);
+
+
+/**
+ * @brief Returns the amount of bytes taken by the data of all the stacks.
+*/
+size_t getStackMemoryUsage();
+
+
 /**
  * @brief Automatically creates a log file by it's name.
  * 
  * @param[in] fileName File name.
  * 
  * @note Don't forget to call `stackDtor` when you're done to close the file.
+ *       The first `stackDtor` closes it and the log goes back to stderr.
 */
 StackError setLogFile(const char* fileName);
 
@@ -0,0 +1,109 @@
+#ifndef STACK_BUDGET_H
+#define STACK_BUDGET_H
+
+#include "stack.h"
+
+/**
+ * @brief Entry of the stack in the process-wide memory accounting.
+ *
+ * The entries are allocated apart from the stack structs, so the list of live stacks
+ * never points to the caller's memory. Idle stacks are shrunk through their entries,
+ * and the stack picks up the moved data on its next operation.
+*/
+struct StackBudget
+{
+    StackBudget* prev;
+    StackBudget* next;
+    const void* owner;          ///< Stack struct using the entry, only compared with.
+    char* memory;               ///< Stack data with its canaries, ending with the right one.
+    size_t committed;           ///< Bytes of the memory.
+    size_t idleSize;            ///< Bytes the memory can be shrunk to, equal to `committed` while the stack is used.
+    unsigned long long lastUse; ///< Operation number of the last stack access.
+    bool pinned;                ///< A pointer to the stack data is given out, so it can't be moved.
+};
+
+
+/**
+ * @brief Adds the new entry to the list of live stacks.
+ *
+ * @param[in] owner Stack struct using the entry.
+ *
+ * @return The entry, NULL if it can't be allocated.
+*/
+StackBudget* budgetRegister(const void* owner);
+
+
+/**
+ * @brief Removes the entry from the list of live stacks and frees it.
+ *
+ * @param[in] budget Memory accounting entry of the stack, may be NULL.
+ *
+ * @note The stack data is not freed.
+*/
+void budgetUnregister(StackBudget* budget);
+
+
+/**
+ * @brief Checks that the entry belongs to the stack struct.
+ *
+ * @param[in] budget Memory accounting entry of the stack.
+ * @param[in] owner  Stack struct.
+ *
+ * @return False if the stack struct was copied or moved after registration.
+*/
+bool budgetIsOwner(const StackBudget* budget, const void* owner);
+
+
+/**
+ * @brief Checks if the stack data can take the given amount of bytes.
+ *
+ * @param[in] budget Memory accounting entry of the stack.
+ * @param[in] bytes  New size of the stack data.
+ *
+ * @return Error code.
+ *
+ * @note Shrinks idle stacks if the soft or the hard limit would be crossed.
+*/
+StackError budgetReserve(StackBudget* budget, size_t bytes);
+
+
+/**
+ * @brief Records the new stack data.
+ *
+ * @param[out] budget Memory accounting entry of the stack.
+ * @param[in]  memory Stack data with its canaries.
+ * @param[in]  bytes  Size of the stack data.
+ *
+ * @note The data isn't shrunk until the next `budgetRelease`.
+*/
+void budgetCommit(StackBudget* budget, void* memory, size_t bytes);
+
+
+/**
+ * @brief Marks the stack as used, unpinning its data.
+ *
+ * @param[out] budget Memory accounting entry of the stack.
+ *
+ * @note The data isn't shrunk until the next `budgetRelease`, so call it before
+ *       accessing the data that could be shrunk while the stack was idle.
+*/
+void budgetTouch(StackBudget* budget);
+
+
+/**
+ * @brief Lets the memory limits shrink the data while the stack is idle.
+ *
+ * @param[out] budget   Memory accounting entry of the stack.
+ * @param[in]  idleSize Bytes the data can be shrunk to.
+*/
+void budgetRelease(StackBudget* budget, size_t idleSize);
+
+
+/**
+ * @brief Keeps the stack data in place until the next `budgetTouch`.
+ *
+ * @param[out] budget Memory accounting entry of the stack.
+*/
+void budgetPin(StackBudget* budget);
+
+#endif
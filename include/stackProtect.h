@@ -0,0 +1,130 @@
+#ifndef STACK_PROTECT_H
+#define STACK_PROTECT_H
+
+#include "stack.h"
+
+// Canary and hash checks shared by the stack implementations.
+// The file including this header defines checkStackError(), calculateStackHash()
+// and calculateDataHash() for its stack struct.
+
+/**
+ * @brief Calculates hash value of the given bytes.
+ *
+ * @param[in] dataStart The bytes.
+ * @param[in] size      Amount of bytes.
+ *
+ * @return Hash value.
+*/
+unsigned long long calculateHash(const char* dataStart, const size_t size);
+
+
+/**
+ * @brief Returns the log file set by `setLogFile` (stderr by default).
+*/
+FILE* getLogFile();
+
+
+/**
+ * @brief Returns the name of the error code.
+ *
+ * @param[in] err Error code.
+*/
+const char* getErrorString(StackError err);
+
+
+#ifndef RELEASE
+    #define STACK_DUMP(stk, stackError) stackDump_internal((stk), (stackError), __FILE__, __LINE__, __FUNCTION__)
+    /**
+     * Verifies the stack structure and returns any errors.
+     * 
+     * @param[in]  stk  The stack structure to be checked.
+     */
+    #define CHECK_DUMP_AND_RETURN_ERROR(stk)                     \
+    do                                                           \
+    {                                                            \
+        StackError defineError = checkStackError(stk);           \
+        if (defineError != NO_ERROR)                             \
+        {                                                        \
+            STACK_DUMP((stk), defineError);                      \
+            return checkStackError((stk));                       \
+        }                                                        \
+    } while (0) 
+
+    /**
+     * Dumps the stack error and returns any errors.
+     * 
+     * @param[in]  stk   The stack structure to be dumped.
+     * @param[in]  error The error to be dumped.
+     * 
+     * @note Does nothing if `error` = `NO_ERROR`.
+     */
+    #define DUMP_AND_RETURN_ERROR(stk, error)                  \
+    do                                                         \
+    {                                                          \
+        if ((error) != NO_ERROR)                               \
+        {                                                      \
+            STACK_DUMP((stk), (error));                        \
+            return (error);                                    \
+        }                                                      \
+    } while (0) 
+
+#else
+    #define CHECK_DUMP_AND_RETURN_ERROR(stk)  ;
+    #define DUMP_AND_RETURN_ERROR(stk, error) ;
+    #define STACK_DUMP(stk, error)            ;
+#endif                                          
+
+
+
+
+
+#ifdef HASH_PROTECT
+       
+    #define CHECK_STACK_HASH_RETURN_ERROR(stk)                            \
+    do                                                                    \
+    {                                                                     \
+        if ((stk)->structHash != calculateStackHash((stk)))               \
+        {                                                                 \
+            DUMP_AND_RETURN_ERROR(stk, UNREGISTERED_STRUCT_ACCESS_ERROR); \
+        }                                                                 \
+    } while (0);
+    
+    #define CHECK_DATA_HASH_RETURN_ERROR(stk)                             \
+    do                                                                    \
+    {                                                                     \
+        if ((stk)->dataHash != calculateDataHash((stk)))                  \
+        {                                                                 \
+            DUMP_AND_RETURN_ERROR(stk, UNREGISTERED_DATA_ACCESS_ERROR);   \
+        }                                                                 \
+    } while (0);
+    
+    
+    #define UPDATE_HASH(stk)                                  \
+    do                                                        \
+    {                                                         \
+        (stk)->structHash = calculateStackHash(stk);          \
+        (stk)->dataHash   = calculateDataHash(stk);           \
+    } while (0);                                              
+    
+
+#else
+    #define CHECK_DATA_HASH_RETURN_ERROR(stk)  ;
+    #define CHECK_STACK_HASH_RETURN_ERROR(stk) ;
+    #define UPDATE_HASH(stk)                   ;
+#endif
+
+
+
+
+
+#define CHECK_CONDITION_RETURN_ERROR(condition, error)        \
+do                                                            \
+{                                                             \
+    if (condition)                                            \
+    {                                                         \
+        stackDump(stk, error);                                \
+        return error;                                         \
+    }                                                         \
+} while (0)
+
+#endif
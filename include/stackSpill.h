@@ -0,0 +1,61 @@
+#ifndef STACK_SPILL_H
+#define STACK_SPILL_H
+
+#include "stack.h"
+
+/**
+ * @brief Creates a temporary spill file.
+ *
+ * @param[out] spill       Spill file state.
+ * @param[in]  segmentSize Amount of elements in one segment.
+ *
+ * @return Error code.
+ *
+ * @note Don't forget to call `spillDtor` when you're done to close the file.
+*/
+StackError spillCtor(StackSpill** spill, stack_size_t segmentSize);
+
+
+/**
+ * @brief Writes a segment on top of the spill file.
+ *
+ * @param[out] spill Spill file state.
+ * @param[in]  src   Segment elements.
+ *
+ * @return Error code.
+*/
+StackError spillWrite(StackSpill* spill, const elem_t* src);
+
+
+/**
+ * @brief Starts reading the top segment of the spill file in the background.
+ *
+ * @param[out] spill Spill file state.
+ *
+ * @note Does nothing if the file is empty or the segment is already being read.
+ *       If the thread can't be started, the segment is read later by `spillRead`.
+*/
+void spillPrefetch(StackSpill* spill);
+
+
+/**
+ * @brief Removes the top segment from the spill file, checking its canaries and hash.
+ *
+ * @param[out] spill Spill file state.
+ * @param[out] dst   Segment elements.
+ *
+ * @return Error code.
+ *
+ * @note Waits for the prefetch started by `spillPrefetch`, if any.
+*/
+StackError spillRead(StackSpill* spill, elem_t* dst);
+
+
+/**
+ * @brief Closes the spill file and frees its state.
+ *
+ * @param[in] spill Spill file state.
+*/
+void spillDtor(StackSpill* spill);
+
+#endif
@@ -0,0 +1,527 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../include/recordStack.h"
+#include "../include/stackProtect.h"
+#include "../include/stackBudget.h"
+
+
+/**
+ * @brief Check record stack class for errors.
+ *
+ * @param[in] stk Record stack struct.
+ *
+ * @return Error code.
+ */
+static StackError checkStackError(const RecordStack* stk);
+
+/**
+ * @brief Calculates record stack hash value.
+ *
+ * @param[in] stk Record stack struct.
+ *
+ * @return Hash value.
+*/
+static unsigned long long calculateStackHash(const RecordStack* stk);
+
+
+/**
+ * @brief Calculates record stack.data[] hash value.
+ *
+ * @param[in] stk Record stack struct.
+ *
+ * @return Hash value.
+*/
+static unsigned long long calculateDataHash(const RecordStack* stk);
+
+
+// Size of the length stored after each record.
+static const stack_size_t TRAILER_SIZE = sizeof(stack_size_t);
+
+#ifdef CANARY_PROTECT
+static const size_t CANARY_SIZE = sizeof(canary_t);
+#else
+static const size_t CANARY_SIZE = 0;
+#endif
+
+
+static StackError checkStackError(const RecordStack* stk)
+{
+    if (stk == NULL)                      return STRUCT_NULL_ERROR;
+#ifdef CANARY_PROTECT
+    if (stk->leftCanary  != CANARY_VALUE) return DEAD_STRUCT_CANARY_ERROR;
+    if (stk->rightCanary != CANARY_VALUE) return DEAD_STRUCT_CANARY_ERROR;
+#endif
+    if (stk->data == NULL)                return DATA_NULL_ERROR;
+    if (stk->capacity < 0)                return NEGATIVE_CAPACITY_ERROR;
+    if (stk->size < 0 || stk->count < 0)  return NEGATIVE_SIZE_ERROR;
+    if (stk->size > stk->capacity)        return SIZE_CAPACITY_ERROR;
+    if (stk->count > stk->size / TRAILER_SIZE) return SIZE_CAPACITY_ERROR;
+    if (!budgetIsOwner(stk->budget, stk)) return STRUCT_MOVED_ERROR;
+#ifdef CANARY_PROTECT
+    if (*(canary_t*)(stk->data - sizeof(canary_t)) != CANARY_VALUE) return DEAD_DATA_CANARY_ERROR;
+    if (*(canary_t*)(stk->data + stk->capacity)    != CANARY_VALUE) return DEAD_DATA_CANARY_ERROR;
+#endif
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Rounds the capacity up so the right data canary stays aligned.
+*/
+static stack_size_t roundCapacity(const stack_size_t capacity)
+{
+    const stack_size_t align = sizeof(canary_t);
+    return (capacity + align - 1) / align * align;
+}
+
+
+static StackError changeCapacity(RecordStack* stk, const stack_size_t capacity)
+{
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    CHECK_CONDITION_RETURN_ERROR(capacity < stk->size, SIZE_CAPACITY_ERROR);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    if ((size_t)capacity > SIZE_MAX - 2 * CANARY_SIZE)
+        return MEMORY_ALLOCATION_ERROR;
+
+    const size_t dataSize = (size_t)capacity + 2 * CANARY_SIZE;
+
+    StackError error = budgetReserve(stk->budget, dataSize);
+    if (error != NO_ERROR)
+        return error;
+
+    char* temp = (char*)realloc(stk->data - CANARY_SIZE, dataSize);
+    if (temp == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    budgetCommit(stk->budget, temp, dataSize);
+
+    const stack_size_t oldCapacity = stk->capacity;
+
+    stk->data     = temp + CANARY_SIZE;
+    stk->capacity = capacity;
+
+    #ifdef CANARY_PROTECT
+    *(canary_t*)(stk->data - sizeof(canary_t)) = CANARY_VALUE;
+    *(canary_t*)(stk->data + stk->capacity)    = CANARY_VALUE;
+    #endif
+
+    #ifndef RELEASE
+    if (stk->capacity > oldCapacity)
+        memset(stk->data + oldCapacity, RECORD_POISON, (size_t)(stk->capacity - oldCapacity));
+    #else
+    (void)oldCapacity;
+    #endif
+
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Finds the top record.
+ *
+ * @param[in]  stk    Record stack struct.
+ * @param[out] offset Offset of the record bytes.
+ * @param[out] length Amount of bytes in the record.
+ *
+ * @return Error code.
+*/
+static StackError findTopRecord(const RecordStack* stk, stack_size_t* offset, stack_size_t* length)
+{
+    assert(stk);
+    assert(offset);
+    assert(length);
+
+    if (stk->count <= 0 || stk->size < TRAILER_SIZE)
+        return POP_OUT_OF_RANGE_ERROR;
+
+    stack_size_t recordLength = 0;
+    memcpy(&recordLength, stk->data + stk->size - TRAILER_SIZE, sizeof(recordLength));
+
+    if (recordLength < 0)                               return NEGATIVE_SIZE_ERROR;
+    if (recordLength > stk->size - TRAILER_SIZE)        return SIZE_CAPACITY_ERROR;
+
+    *offset = stk->size - TRAILER_SIZE - recordLength;
+    *length = recordLength;
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Marks the record stack as used, picking up its data moved by the memory limits.
+ *
+ * @param[out] stk Record stack struct.
+ *
+ * @note The data of the idle stack can be shrunk by the operations on other stacks.
+*/
+static void holdData(RecordStack* stk)
+{
+    // The copied or moved stack is reported by checkStackError.
+    if (!budgetIsOwner(stk->budget, stk))
+        return;
+
+    budgetTouch(stk->budget);
+
+    char* data = stk->budget->memory + CANARY_SIZE;
+    stack_size_t capacity = (stack_size_t)(stk->budget->committed - 2 * CANARY_SIZE);
+
+    if (data != stk->data || capacity != stk->capacity)
+    {
+        stk->data     = data;
+        stk->capacity = capacity;
+
+        // The records are kept, so only the struct hash is updated.
+        #ifdef HASH_PROTECT
+        stk->structHash = calculateStackHash(stk);
+        #endif
+    }
+}
+
+
+/**
+ * @brief Lets the memory limits shrink the data to fit the size while the record stack is idle.
+ *
+ * @param[in] stk Record stack struct.
+*/
+static void releaseData(const RecordStack* stk)
+{
+    size_t idleSize = stk->budget->committed;
+
+    if (stk->size <= INT64_MAX / STACK_CAPACITY_MULTIPLIER)
+    {
+        stack_size_t capacity = roundCapacity(stk->size * STACK_CAPACITY_MULTIPLIER);
+        if (capacity < RECORD_STACK_CAPACITY_DEFAULT)
+            capacity = RECORD_STACK_CAPACITY_DEFAULT;
+
+        if (capacity < stk->capacity)
+            idleSize = (size_t)capacity + 2 * CANARY_SIZE;
+    }
+
+    budgetRelease(stk->budget, idleSize);
+}
+
+
+StackError recordStackInit_internal(RecordStack* stk, size_t capacity, StackInitInfo info)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(capacity > SIZE_MAX / 2, MEMORY_ALLOCATION_ERROR);
+
+    stk->capacity = roundCapacity((stack_size_t)capacity);
+    stk->size     = 0;
+    stk->count    = 0;
+    stk->budget   = NULL;
+    stk->info     = info;
+
+    #ifdef CANARY_PROTECT
+    stk->leftCanary  = CANARY_VALUE;
+    stk->rightCanary = CANARY_VALUE;
+    #endif
+
+    // Memory for data and 2 canary elements.
+    const size_t dataSize = (size_t)stk->capacity + 2 * CANARY_SIZE;
+
+    stk->budget = budgetRegister(stk);
+    if (stk->budget == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    StackError error = budgetReserve(stk->budget, dataSize);
+    if (error != NO_ERROR)
+    {
+        budgetUnregister(stk->budget);
+        stk->budget = NULL;
+        return error;
+    }
+
+    char* buffer = (char*)malloc(dataSize);
+    if (buffer == NULL)
+    {
+        budgetUnregister(stk->budget);
+        stk->budget = NULL;
+        return MEMORY_ALLOCATION_ERROR;
+    }
+
+    budgetCommit(stk->budget, buffer, dataSize);
+
+    stk->data = buffer + CANARY_SIZE;
+
+    #ifdef CANARY_PROTECT
+    *(canary_t*)(stk->data - sizeof(canary_t)) = CANARY_VALUE;
+    *(canary_t*)(stk->data + stk->capacity)    = CANARY_VALUE;
+    #endif
+
+    #ifndef RELEASE
+    memset(stk->data, RECORD_POISON, (size_t)stk->capacity);
+    #endif
+
+    UPDATE_HASH(stk);
+    releaseData(stk);
+
+    return NO_ERROR;
+}
+
+
+StackError recordStackInit_internal(RecordStack* stk, StackInitInfo info)
+{
+    return recordStackInit_internal(stk, RECORD_STACK_CAPACITY_DEFAULT, info);
+}
+
+
+StackError recordStackPush(RecordStack* stk, const void* record, size_t recordSize)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(record == NULL && recordSize > 0, ELEM_NULL_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    // The record may lie in the stack data, e.g. the one from `recordStackPeek`,
+    // which is moved by the reallocations below.
+    const size_t recordOffset = (size_t)record - (size_t)stk->data;
+    const bool   isInside     = recordSize > 0 && recordOffset < (size_t)stk->size;
+
+    CHECK_CONDITION_RETURN_ERROR(recordSize > (size_t)(INT64_MAX - stk->size - TRAILER_SIZE),
+                                 MEMORY_ALLOCATION_ERROR);
+
+    const stack_size_t length   = (stack_size_t)recordSize;
+    const stack_size_t required = stk->size + length + TRAILER_SIZE;
+
+    if (required > stk->capacity)
+    {
+        stack_size_t capacity = stk->capacity;
+        if (capacity < RECORD_STACK_CAPACITY_DEFAULT)
+            capacity = RECORD_STACK_CAPACITY_DEFAULT;
+        while (capacity < required && capacity <= INT64_MAX / STACK_CAPACITY_MULTIPLIER)
+            capacity *= STACK_CAPACITY_MULTIPLIER;
+        if (capacity < required)
+            capacity = required;
+
+        StackError error = changeCapacity(stk, roundCapacity(capacity));
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
+
+    if (isInside)
+        record = stk->data + recordOffset;
+
+    memcpy(stk->data + stk->size, record, recordSize);
+    stk->size += length;
+
+    memcpy(stk->data + stk->size, &length, sizeof(length));
+    stk->size += TRAILER_SIZE;
+
+    stk->count++;
+
+    UPDATE_HASH(stk);
+    releaseData(stk);
+    return NO_ERROR;
+}
+
+
+StackError recordStackPop(RecordStack* stk, void* buffer, size_t bufferSize, size_t* recordSize)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(recordSize == NULL, ELEM_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, DATA_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->count <= 0, POP_OUT_OF_RANGE_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    stack_size_t offset = 0;
+    stack_size_t length = 0;
+    StackError error = findTopRecord(stk, &offset, &length);
+    DUMP_AND_RETURN_ERROR(stk, error);
+
+    *recordSize = (size_t)length;
+    if ((size_t)length > bufferSize)
+    {
+        releaseData(stk);
+        return RECORD_BUFFER_SIZE_ERROR;
+    }
+
+    CHECK_CONDITION_RETURN_ERROR(buffer == NULL && length > 0, ELEM_NULL_ERROR);
+
+    memcpy(buffer, stk->data + offset, (size_t)length);
+
+    #ifndef RELEASE
+    memset(stk->data + offset, RECORD_POISON, (size_t)(stk->size - offset));
+    #endif
+
+    stk->size = offset;
+    stk->count--;
+
+    UPDATE_HASH(stk);
+
+    // If the size is STACK_CAPACITY_MULTIPLIER^2 smaller, than the capacity,...
+    if (stk->size <= stk->capacity / (STACK_CAPACITY_MULTIPLIER * STACK_CAPACITY_MULTIPLIER)
+        && stk->capacity > RECORD_STACK_CAPACITY_DEFAULT)
+    {
+        //... decrease the capacity.
+        changeCapacity(stk, roundCapacity(stk->capacity / STACK_CAPACITY_MULTIPLIER));
+        UPDATE_HASH(stk);
+    }
+
+    releaseData(stk);
+    return NO_ERROR;
+}
+
+
+StackError recordStackPeek(RecordStack* stk, const void** record, size_t* recordSize)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(record == NULL || recordSize == NULL, ELEM_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, DATA_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->count <= 0, POP_OUT_OF_RANGE_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    stack_size_t offset = 0;
+    stack_size_t length = 0;
+    StackError error = findTopRecord(stk, &offset, &length);
+    DUMP_AND_RETURN_ERROR(stk, error);
+
+    // The memory limits don't move the data until the next push or pop.
+    budgetPin(stk->budget);
+    releaseData(stk);
+
+    *record     = stk->data + offset;
+    *recordSize = (size_t)length;
+
+    return NO_ERROR;
+}
+
+
+StackError recordStackDtor(RecordStack* stk)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk       == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL,   DATA_NULL_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    #ifndef RELEASE
+    memset(stk->data, RECORD_POISON, (size_t)stk->capacity);
+    #endif
+
+    free(stk->data - CANARY_SIZE);
+    stk->data = NULL;
+    budgetUnregister(stk->budget);
+    stk->budget = NULL;
+
+    return NO_ERROR;
+}
+
+
+void stackDump_internal(const RecordStack* stk, const StackError err,
+               const char* fileName, const size_t line, const char* funcName)
+{
+    FILE* stkerr = getLogFile();
+
+    #define print(...) fprintf(stkerr, __VA_ARGS__)
+    #define printColor(color, str,...) fprintf(stkerr, "<font color=" #color ">" str "</font>", __VA_ARGS__)
+
+    print("<pre>");
+
+    if (err == STRUCT_NULL_ERROR)
+    {
+        printColor(red, "NULL record stack in file %s(%lu) function %s\n", fileName, line, funcName);
+        return;
+    }
+
+    print("----------------------------------------------------------------\n");
+
+    printColor(purple, "%s[%p] ", stk->info.varName, stk);
+    print("was initialized in ");
+    printColor(purple, "%s ", stk->info.fileName);
+    print("function ");
+    printColor(purple, "%s(%d)\n", stk->info.funcName, stk->info.lineNum);
+    print("\tcalled from ");
+    printColor(purple, "%s ", fileName);
+    print("function ");
+    printColor(purple, "%s(%lu):\n", funcName, line);
+
+    if (err == NO_ERROR)
+        printColor(green, "\t\t\t  ERROR CODE: %s\n", getErrorString(err));
+    else
+        printColor(red, "\t\t\t  ERROR CODE: %s\n", getErrorString(err));
+
+    print("\t *size = " STACK_SIZE_FORMAT "      \n", stk->size);
+    print("\t *capacity = " STACK_SIZE_FORMAT "  \n", stk->capacity);
+    print("\t *count = " STACK_SIZE_FORMAT "     \n", stk->count);
+    print("\t *data[%p]:      \n", stk->data);
+
+    if (stk->data == NULL || err == NEGATIVE_CAPACITY_ERROR || err == NEGATIVE_SIZE_ERROR ||
+        err == SIZE_CAPACITY_ERROR || err == UNREGISTERED_STRUCT_ACCESS_ERROR || err == STRUCT_MOVED_ERROR)
+        return;
+
+    // Walk the records from the top using their lengths.
+    stack_size_t end = stk->size;
+    for (stack_size_t i = stk->count - 1; i >= 0 && end >= TRAILER_SIZE; i--)
+    {
+        stack_size_t length = 0;
+        memcpy(&length, stk->data + end - TRAILER_SIZE, sizeof(length));
+        if (length < 0 || length > end - TRAILER_SIZE)
+        {
+            printColor(red, "\t\t@ record[" STACK_SIZE_FORMAT "] has broken length " STACK_SIZE_FORMAT "\n",
+                       i, length);
+            break;
+        }
+
+        stack_size_t offset = end - TRAILER_SIZE - length;
+        print("\t\t@ record[" STACK_SIZE_FORMAT "] (" STACK_SIZE_FORMAT " bytes) =", i, length);
+
+        // Print only the beginning of long records.
+        const stack_size_t printLength = length < 16 ? length : 16;
+        for (stack_size_t j = 0; j < printLength; j++)
+            print(" %02x", (unsigned char)stk->data[offset + j]);
+        if (printLength < length)
+            print(" ...");
+        print("\n");
+
+        end = offset;
+    }
+
+    #undef print
+    #undef printColor
+}
+
+
+static unsigned long long calculateStackHash(const RecordStack* stk)
+{
+    assert(stk);
+
+    // Hash all the fields from data to info.
+    size_t stackSize = offsetof(RecordStack, info) - offsetof(RecordStack, data);
+    return calculateHash((const char*)(&(stk->data)), stackSize);
+}
+
+
+static unsigned long long calculateDataHash(const RecordStack* stk)
+{
+    assert(stk);
+
+    return calculateHash(stk->data, (size_t)stk->size);
+}
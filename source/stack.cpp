@@ -1,4 +1,10 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include "../include/stack.h"
+#include "../include/stackProtect.h"
+#include "../include/stackBudget.h"
+#include "../include/stackSpill.h"
 
 
 static FILE* stkerr = stderr;
@@ -9,6 +15,12 @@ static const char* ErrorString[] =
     ERROR_NAME(GENERATE_STRING)
 };
 
+#ifdef CANARY_PROTECT
+static const size_t CANARY_SIZE = sizeof(canary_t);
+#else
+static const size_t CANARY_SIZE = 0;
+#endif
+
 /**
  * @brief Check stack class for errors.
  * 
@@ -40,104 +52,25 @@ static unsigned long long calculateStackHash(const Stack* stk);
 static unsigned long long calculateDataHash(const Stack* stk);
 
 
-
-
-
-// TODO: move to .cpp
-#ifndef RELEASE
-    #define STACK_DUMP(stk, stackError) stackDump_internal((stk), (stackError), __FILE__, __LINE__, __FUNCTION__)
-    /**
-     * Verifies the stack structure and returns any errors.
-     * 
-     * @param[in]  stk  The stack structure to be checked.
-     */
-    #define CHECK_DUMP_AND_RETURN_ERROR(stk)                     \
-    do                                                           \
-    {                                                            \
-        StackError defineError = checkStackError(stk);           \
-        if (defineError != NO_ERROR)                             \
-        {                                                        \
-            STACK_DUMP((stk), defineError);                      \
-            return checkStackError((stk));                       \
-        }                                                        \
-    } while (0) 
-
-    /**
-     * Dumps the stack error and returns any errors.
-     * 
-     * @param[in]  stk   The stack structure to be dumped.
-     * @param[in]  error The error to be dumped.
-     * 
-     * @note Does nothing if `error` = `NO_ERROR`.
-     */
-    #define DUMP_AND_RETURN_ERROR(stk, error)                  \
-    do                                                         \
-    {                                                          \
-        if ((error) != NO_ERROR)                               \
-        {                                                      \
-            STACK_DUMP((stk), (error));                        \
-            return (error);                                    \
-        }                                                      \
-    } while (0) 
-
-#else
-    #define CHECK_DUMP_AND_RETURN_ERROR(stk)  ;
-    #define DUMP_AND_RETURN_ERROR(stk, error) ;
-    #define STACK_DUMP(stk, error)            ;
-#endif                                          
-
-
-
-
-
-#ifdef HASH_PROTECT
-       
-    #define CHECK_STACK_HASH_RETURN_ERROR(stk)                            \
-    do                                                                    \
-    {                                                                     \
-        if ((stk)->structHash != calculateStackHash((stk)))               \
-        {                                                                 \
-            DUMP_AND_RETURN_ERROR(stk, UNREGISTERED_STRUCT_ACCESS_ERROR); \
-        }                                                                 \
-    } while (0);
-    
-    #define CHECK_DATA_HASH_RETURN_ERROR(stk)                             \
-    do                                                                    \
-    {                                                                     \
-        if ((stk)->dataHash != calculateDataHash((stk)))                  \
-        {                                                                 \
-            DUMP_AND_RETURN_ERROR(stk, UNREGISTERED_DATA_ACCESS_ERROR);   \
-        }                                                                 \
-    } while (0);
-    
-    
-    #define UPDATE_HASH(stk)                                  \
-    do                                                        \
-    {                                                         \
-        (stk)->structHash = calculateStackHash(stk);          \
-        (stk)->dataHash   = calculateDataHash(stk);           \
-    } while (0);                                              
-    
-
-#else
-    #define CHECK_DATA_HASH_RETURN_ERROR(stk)  ;
-    #define CHECK_STACK_HASH_RETURN_ERROR(stk) ;
-    #define UPDATE_HASH(stk)                   ;
-#endif
-
-
-
-
-
-#define CHECK_CONDITION_RETURN_ERROR(condition, error)        \
-do                                                            \
-{                                                             \
-    if (condition)                                            \
-    {                                                         \
-        stackDump(stk, error);                                \
-        return error;                                         \
-    }                                                         \
-} while (0)
+/**
+ * @brief Elements shared by the forked stacks.
+ * 
+ * It's the former data of the forked stack, which is never changed.
+*/
+struct StackShared
+{
+    long refCount;             ///< Amount of stacks and shared data using it.
+    StackShared* parent;       ///< Shared elements below these ones, NULL if none.
+    stack_size_t parentSize;   ///< Amount of elements of the parent below these ones.
+    elem_t* data;              ///< Elements.
+    stack_size_t size;         ///< Amount of elements.
+    stack_size_t capacity;     ///< Max size of the data.
+    StackBudget* budget;       ///< Memory accounting entry.
+
+    #ifdef HASH_PROTECT
+    unsigned long long dataHash;
+    #endif
+};
 
 
 
@@ -148,13 +81,19 @@ static StackError checkStackError(Stack *stk)
 #ifdef CANARY_PROTECT
     if (stk->leftCanary  != CANARY_VALUE) return DEAD_STRUCT_CANARY_ERROR;
     if (stk->rightCanary != CANARY_VALUE) return DEAD_STRUCT_CANARY_ERROR;
-
+#endif
+    // The data of the copied stack could be moved by the memory limits.
+    if (!budgetIsOwner(stk->budget, stk)) return STRUCT_MOVED_ERROR;
+#ifdef CANARY_PROTECT
     if (*(canary_t*)((size_t)stk->data - sizeof(canary_t)) != CANARY_VALUE) return DEAD_DATA_CANARY_ERROR;
     if (*(canary_t*)(stk->data + stk->capacity) != CANARY_VALUE)            return DEAD_DATA_CANARY_ERROR;
 #endif
     if (stk       == NULL)                return STRUCT_NULL_ERROR;
     if (stk->capacity < 0)                return NEGATIVE_CAPACITY_ERROR;
     if (stk->size     < 0)                return NEGATIVE_SIZE_ERROR;
+    if (stk->spilledSize < 0)             return NEGATIVE_SIZE_ERROR;
+    if (stk->baseSize < 0)                return NEGATIVE_SIZE_ERROR;
+    if (stk->base == NULL && stk->baseSize != 0) return DATA_NULL_ERROR;
     if (stk->data == NULL)                return DATA_NULL_ERROR;
     if (stk->size > stk->capacity)        return SIZE_CAPACITY_ERROR;
     else      /*POST IRONIYA*/            return NO_ERROR;
@@ -162,30 +101,62 @@ static StackError checkStackError(Stack *stk)
 }
 
 
-static StackError increaseCapacity(Stack* stk, const float coef)
+/**
+ * @brief Rounds the capacity up so the right data canary stays aligned.
+ * 
+ * @return Rounded capacity or -1 if it can't be represented.
+*/
+static stack_size_t roundCapacity(const stack_size_t capacity)
+{
+    const stack_size_t align = sizeof(canary_t);
+    if (capacity > INT64_MAX - align)
+        return -1;
+
+    return (capacity + align - 1) / align * align;
+}
+
+
+static StackError changeCapacity(Stack* stk, const stack_size_t capacity)
 {
     CHECK_STACK_HASH_RETURN_ERROR(stk);
 
     CHECK_CONDITION_RETURN_ERROR(stk == NULL,     STRUCT_NULL_ERROR);
     CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, DATA_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(capacity < stk->size, SIZE_CAPACITY_ERROR);
 
     CHECK_DATA_HASH_RETURN_ERROR(stk);
 
-    stk->capacity = (int)((float)stk->capacity * coef);
+    #ifdef CANARY_PROTECT
+    const size_t extraSize = 2 * sizeof(canary_t);
+    #else
+    const size_t extraSize = 0;
+    #endif
+
+    if ((size_t)capacity > (SIZE_MAX - extraSize) / sizeof(elem_t))
+        return MEMORY_ALLOCATION_ERROR;
+
+    const size_t dataSize = (size_t)capacity * sizeof(elem_t) + extraSize;
+
+    StackError error = budgetReserve(stk->budget, dataSize);
+    if (error != NO_ERROR)
+        return error;
+
+    const stack_size_t oldCapacity = stk->capacity;
 
     #ifdef CANARY_PROTECT
 
     // Move the data to the originally allocated place.
     stk->data = (elem_t*)(size_t(stk->data) - sizeof(canary_t));
 
-    elem_t* temp = (elem_t*)realloc(stk->data, stk->capacity * sizeof(elem_t) + 2 * sizeof(canary_t));
+    elem_t* temp = (elem_t*)realloc(stk->data, dataSize);
     if (temp == NULL)
     {
-        stk->capacity = (int)((float)stk->capacity / coef);
+        stk->data = (elem_t*)((size_t)stk->data + sizeof(canary_t));
         return MEMORY_ALLOCATION_ERROR;
     }
 
     stk->data = temp;
+    stk->capacity = capacity;
 
     ((canary_t*)stk->data)[0] = CANARY_VALUE;
 
@@ -195,17 +166,19 @@ static StackError increaseCapacity(Stack* stk, const float coef)
 
     #else
 
-    elem_t* temp = (elem_t*)realloc(stk->data, sizeof(elem_t) * stk->capacity);
+    elem_t* temp = (elem_t*)realloc(stk->data, dataSize);
     if (temp == NULL) return MEMORY_ALLOCATION_ERROR;
      
     stk->data = temp;
+    stk->capacity = capacity;
 
     #endif
 
+    budgetCommit(stk->budget, (char*)stk->data - CANARY_SIZE, dataSize);
 
     #ifndef RELEASE
 
-    for (int i = (int)((float)stk->capacity / coef); i < stk->capacity; i++)
+    for (stack_size_t i = oldCapacity; i < stk->capacity; i++)
     {
         stk->data[i] = POISON;
     }
@@ -217,24 +190,184 @@ static StackError increaseCapacity(Stack* stk, const float coef)
 }
 
 
-StackError stackInit_internal(Stack* stk, size_t capacity, StackInitInfo info)
+/**
+ * @brief Calculates the capacity the stack should grow to.
+ * 
+ * @param[in] stk Stack struct.
+ * 
+ * @return New capacity or -1 if it can't be represented.
+*/
+static stack_size_t nextCapacity(const Stack* stk)
 {
-    CHECK_CONDITION_RETURN_ERROR(stk == NULL, DATA_NULL_ERROR);
+    if (stk->capacity > INT64_MAX / STACK_CAPACITY_MULTIPLIER)
+        return -1;
 
-    stk->capacity = (int)capacity;
-    stk->size = 0;
-    stk->info = info;
+    stack_size_t capacity = stk->capacity * STACK_CAPACITY_MULTIPLIER;
+    if (capacity < STACK_SIZE_DEFAULT)
+        capacity = STACK_SIZE_DEFAULT;
+
+    if (stk->spill != NULL && capacity > stk->spillCapacity)
+        capacity = stk->spillCapacity;
+
+    return capacity;
+}
+
+
+/**
+ * @brief Writes the bottom half of the stack to the spill file.
+ * 
+ * @param[out] stk Stack struct.
+ * 
+ * @return Error code.
+ * 
+ * @note Moving half of the data at once keeps the cost of the memmove O(1) per element.
+*/
+static StackError spillBottomHalf(Stack* stk)
+{
+    stack_size_t segments = stk->size / STACK_SPILL_SEGMENT_SIZE / 2;
+    if (segments < 1)
+        segments = 1;
+
+    StackError error = NO_ERROR;
+    stack_size_t spilled = 0;
+    for (stack_size_t i = 0; i < segments && error == NO_ERROR; i++)
+    {
+        error = spillWrite(stk->spill, stk->data + spilled);
+        if (error == NO_ERROR)
+            spilled += STACK_SPILL_SEGMENT_SIZE;
+    }
+
+    // Keep the segments that were written even if a later one failed.
+    stk->size        -= spilled;
+    stk->spilledSize += spilled;
+
+    memmove(stk->data, stk->data + spilled, (size_t)stk->size * sizeof(elem_t));
+
+    #ifndef RELEASE
+    for (stack_size_t i = stk->size; i < stk->size + spilled; i++)
+        stk->data[i] = POISON;
+    #endif
+
+    return error;
+}
+
+
+/**
+ * @brief Reads the top segment of the spill file back to the empty stack.
+ * 
+ * @param[out] stk Stack struct.
+ * 
+ * @return Error code.
+*/
+static StackError reloadTopSegment(Stack* stk)
+{
+    assert(stk->size == 0);
+    assert(stk->capacity >= STACK_SPILL_SEGMENT_SIZE);
+
+    StackError error = spillRead(stk->spill, stk->data);
+    if (error != NO_ERROR)
+        return error;
+
+    stk->size         = STACK_SPILL_SEGMENT_SIZE;
+    stk->spilledSize -= STACK_SPILL_SEGMENT_SIZE;
+
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Marks the stack as used, picking up its data moved by the memory limits.
+ * 
+ * @param[out] stk Stack struct.
+ * 
+ * @note The data of the idle stack can be shrunk by the operations on other stacks.
+*/
+static void holdData(Stack* stk)
+{
+    // The copied or moved stack is reported by checkStackError.
+    if (!budgetIsOwner(stk->budget, stk))
+        return;
+
+    budgetTouch(stk->budget);
+
+    elem_t* data = (elem_t*)(stk->budget->memory + CANARY_SIZE);
+    stack_size_t capacity = (stack_size_t)((stk->budget->committed - 2 * CANARY_SIZE) / sizeof(elem_t));
 
+    if (data != stk->data || capacity != stk->capacity)
+    {
+        stk->data     = data;
+        stk->capacity = capacity;
+
+        // The elements are kept, so only the struct hash is updated.
+        #ifdef HASH_PROTECT
+        stk->structHash = calculateStackHash(stk);
+        #endif
+    }
+}
+
+
+/**
+ * @brief Lets the memory limits shrink the data to fit the size while the stack is idle.
+ * 
+ * @param[in] stk Stack struct.
+*/
+static void releaseData(const Stack* stk)
+{
+    size_t idleSize = stk->budget->committed;
+
+    // The spilled stack is already limited by its own budget.
+    if (stk->spilledSize == 0 && stk->size <= INT64_MAX / STACK_CAPACITY_MULTIPLIER)
+    {
+        stack_size_t capacity = roundCapacity(stk->size * STACK_CAPACITY_MULTIPLIER);
+        if (capacity < STACK_SIZE_DEFAULT)
+            capacity = STACK_SIZE_DEFAULT;
+
+        if (capacity < stk->capacity)
+            idleSize = (size_t)capacity * sizeof(elem_t) + 2 * CANARY_SIZE;
+    }
+
+    budgetRelease(stk->budget, idleSize);
+}
+
+
+/**
+ * @brief Allocates new data for the stack.
+ * 
+ * @param[out] stk      Stack struct.
+ * @param[in]  capacity Capacity of the new data.
+ * 
+ * @return Error code.
+ * 
+ * @note The old data is not freed.
+*/
+static StackError allocData(Stack* stk, const stack_size_t capacity)
+{
     #ifdef CANARY_PROTECT
-    stk->leftCanary  = CANARY_VALUE;
-    stk->rightCanary = CANARY_VALUE;
+    // Memory for data and 2 canary elements.
+    const size_t extraSize = 2 * sizeof(canary_t);
+    #else
+    const size_t extraSize = 0;
     #endif
 
+    if (capacity < 0 || (size_t)capacity > (SIZE_MAX - extraSize) / sizeof(elem_t))
+        return MEMORY_ALLOCATION_ERROR;
+
+    const size_t dataSize = (size_t)capacity * sizeof(elem_t) + extraSize;
+
+    StackError error = budgetReserve(stk->budget, dataSize);
+    if (error != NO_ERROR)
+        return error;
+
+    elem_t* data = (elem_t*)malloc(dataSize);
+    if (data == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    budgetCommit(stk->budget, data, dataSize);
+
+    stk->data     = data;
+    stk->capacity = capacity;
+
     #ifdef CANARY_PROTECT
-    
-    // Allocate memory for data and 2 canary elements.
-    stk->data = (elem_t*)malloc(capacity * sizeof(elem_t) + 2 * sizeof(canary_t));
-    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, MEMORY_ALLOCATION_ERROR);
 
     // Set the left canary.
     ((canary_t*)stk->data)[0] = CANARY_VALUE;
@@ -245,18 +378,215 @@ StackError stackInit_internal(Stack* stk, size_t capacity, StackInitInfo info)
     // Set the right canary.
     ((canary_t*)(stk->data + stk->capacity))[0] = CANARY_VALUE;
 
-    #else
-    stk->data = (elem_t*)malloc(capacity * sizeof(elem_t));
-    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, MEMORY_ALLOCATION_ERROR);
     #endif
 
 
     #ifndef RELEASE
-    for (int i = 0; i < stk->capacity; i++)
+    for (stack_size_t i = 0; i < stk->capacity; i++)
         stk->data[i] = POISON;
     #endif
 
+    return NO_ERROR;
+}
+
+
+static void releaseShared(StackShared* shared)
+{
+    while (shared != NULL && --shared->refCount == 0)
+    {
+        StackShared* parent = shared->parent;
+
+        budgetUnregister(shared->budget);
+        #ifdef CANARY_PROTECT
+        free((char*)shared->data - sizeof(canary_t));
+        #else
+        free((char*)shared->data);
+        #endif
+        free(shared);
+
+        shared = parent;
+    }
+}
+
+
+static StackError checkSharedError(const StackShared* shared)
+{
+#ifdef CANARY_PROTECT
+    if (*(canary_t*)((size_t)shared->data - sizeof(canary_t)) != CANARY_VALUE) return DEAD_DATA_CANARY_ERROR;
+    if (*(canary_t*)(shared->data + shared->capacity) != CANARY_VALUE)         return DEAD_DATA_CANARY_ERROR;
+#endif
+#ifdef HASH_PROTECT
+    if (shared->dataHash != calculateHash((const char*)shared->data, (size_t)shared->size * sizeof(elem_t)))
+        return UNREGISTERED_DATA_ACCESS_ERROR;
+#endif
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Moves the stack data to the new shared data under the stack.
+ * 
+ * @param[out] stk Stack struct.
+ * 
+ * @return Error code.
+ * 
+ * @note The stack gets new empty data.
+*/
+static StackError shareData(Stack* stk)
+{
+    StackShared* shared = (StackShared*)calloc(1, sizeof(StackShared));
+    if (shared == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    // The shared data is never released, so the memory limits don't shrink it.
+    shared->budget = budgetRegister(shared);
+    if (shared->budget == NULL)
+    {
+        free(shared);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+
+    elem_t* data = stk->data;
+    const stack_size_t capacity  = stk->capacity;
+    const size_t       committed = stk->budget->committed;
+
+    // The shared data takes over the memory of the stack data.
+    budgetCommit(shared->budget, (char*)data - CANARY_SIZE, committed);
+    budgetCommit(stk->budget, NULL, 0);
+
+    StackError error = allocData(stk, STACK_SIZE_DEFAULT);
+    if (error != NO_ERROR)
+    {
+        budgetCommit(stk->budget, (char*)data - CANARY_SIZE, committed);
+        budgetUnregister(shared->budget);
+        free(shared);
+        return error;
+    }
+
+    shared->refCount   = 1;
+    shared->parent     = stk->base;
+    shared->parentSize = stk->baseSize;
+    shared->data       = data;
+    shared->size       = stk->size;
+    shared->capacity   = capacity;
+    #ifdef HASH_PROTECT
+    shared->dataHash   = stk->dataHash;
+    #endif
+
+    #ifdef CANARY_PROTECT
+    const size_t extraSize = 2 * sizeof(canary_t);
+    char* buffer = (char*)shared->data - sizeof(canary_t);
+    #else
+    const size_t extraSize = 0;
+    char* buffer = (char*)shared->data;
+    #endif
+
+    // Free the unused capacity, keeping the old data if it fails.
+    const stack_size_t sharedCapacity = roundCapacity(shared->size);
+    const size_t dataSize = (size_t)sharedCapacity * sizeof(elem_t) + extraSize;
+    buffer = (char*)realloc(buffer, dataSize);
+    if (buffer != NULL)
+    {
+        shared->data     = (elem_t*)(buffer + extraSize / 2);
+        shared->capacity = sharedCapacity;
+        budgetCommit(shared->budget, buffer, dataSize);
+
+        #ifdef CANARY_PROTECT
+        ((canary_t*)(shared->data + shared->capacity))[0] = CANARY_VALUE;
+        #endif
+    }
+
+    stk->base     = shared;
+    stk->baseSize = shared->size;
+    stk->size     = 0;
+
+    return NO_ERROR;
+}
+
+
+/**
+ * @brief Copies the top segment of the shared data to the empty stack.
+ * 
+ * @param[out] stk Stack struct.
+ * 
+ * @return Error code.
+*/
+static StackError pullSharedSegment(Stack* stk)
+{
+    assert(stk->size == 0);
+    assert(stk->base != NULL && stk->baseSize > 0);
+
+    StackError error = checkSharedError(stk->base);
+    if (error != NO_ERROR)
+        return error;
+
+    const stack_size_t count = stk->baseSize < STACK_FORK_SEGMENT_SIZE ? stk->baseSize : STACK_FORK_SEGMENT_SIZE;
+    if (stk->capacity < count)
+    {
+        error = changeCapacity(stk, roundCapacity(count));
+        if (error != NO_ERROR)
+            return error;
+    }
+
+    stk->baseSize -= count;
+    memcpy(stk->data, stk->base->data + stk->baseSize, (size_t)count * sizeof(elem_t));
+    stk->size = count;
+
+    // Move to the parent when the shared data is used up.
+    while (stk->base != NULL && stk->baseSize == 0)
+    {
+        StackShared* base = stk->base;
+
+        stk->base     = base->parent;
+        stk->baseSize = base->parentSize;
+        if (stk->base != NULL)
+            stk->base->refCount++;
+
+        releaseShared(base);
+    }
+
+    return NO_ERROR;
+}
+
+
+StackError stackInit_internal(Stack* stk, size_t capacity, StackInitInfo info)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk == NULL, DATA_NULL_ERROR);
+
+    stk->data = NULL;
+    stk->capacity = 0;
+    stk->size = 0;
+    stk->spill = NULL;
+    stk->spilledSize = 0;
+    stk->spillCapacity = 0;
+    stk->base = NULL;
+    stk->baseSize = 0;
+    stk->budget = NULL;
+    stk->info = info;
+
+    #ifdef CANARY_PROTECT
+    stk->leftCanary  = CANARY_VALUE;
+    stk->rightCanary = CANARY_VALUE;
+    #endif
+
+    // The capacity must fit into stack_size_t.
+    if (capacity > (size_t)INT64_MAX)
+        return MEMORY_ALLOCATION_ERROR;
+
+    stk->budget = budgetRegister(stk);
+    if (stk->budget == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    StackError error = allocData(stk, roundCapacity((stack_size_t)capacity));
+    if (error != NO_ERROR)
+    {
+        budgetUnregister(stk->budget);
+        stk->budget = NULL;
+        return error;
+    }
+
     UPDATE_HASH(stk);
+    releaseData(stk);
 
     return NO_ERROR;
 }
@@ -274,19 +604,33 @@ StackError stackPush(Stack* stk, const elem_t elem)
 
     CHECK_STACK_HASH_RETURN_ERROR(stk);
 
+    holdData(stk);
+
     CHECK_DUMP_AND_RETURN_ERROR(stk);
 
     CHECK_DATA_HASH_RETURN_ERROR(stk);    
-    
+
     if (stk->size >= stk->capacity)
     {
-        StackError error = increaseCapacity(stk, STACK_CAPACITY_MULTIPLIER);
+        StackError error = NO_ERROR;
+        if (stk->spill != NULL && stk->capacity >= stk->spillCapacity)
+        {
+            // The written segments are removed from the stack even if a later one failed.
+            error = spillBottomHalf(stk);
+            UPDATE_HASH(stk);
+        }
+        else
+        {
+            stack_size_t capacity = nextCapacity(stk);
+            error = (capacity < 0) ? MEMORY_ALLOCATION_ERROR : changeCapacity(stk, capacity);
+        }
         DUMP_AND_RETURN_ERROR(stk, error);
     }
 
     stk->data[stk->size++] = elem;
 
     UPDATE_HASH(stk);
+    releaseData(stk);
     return NO_ERROR;
 }
 
@@ -296,25 +640,84 @@ StackError stackPop(Stack* stk, elem_t* elem)
     CHECK_CONDITION_RETURN_ERROR(stk == NULL, ELEM_NULL_ERROR);
     CHECK_CONDITION_RETURN_ERROR(elem == NULL, ELEM_NULL_ERROR);
     CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, DATA_NULL_ERROR);
-    CHECK_CONDITION_RETURN_ERROR(stk->size <= 0, POP_OUT_OF_RANGE_ERROR); 
+    CHECK_CONDITION_RETURN_ERROR(stk->size <= 0 && stk->spilledSize <= 0 && stk->base == NULL,
+                                 POP_OUT_OF_RANGE_ERROR); 
 
     CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
     
     CHECK_DUMP_AND_RETURN_ERROR(stk);
     
     CHECK_DATA_HASH_RETURN_ERROR(stk);
 
+    if (stk->size == 0)
+    {
+        // Spilled elements lie between the shared ones and the stack data.
+        StackError error = (stk->spilledSize > 0) ? reloadTopSegment(stk) : pullSharedSegment(stk);
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
     // If the size is STACK_CAPACITY_MULTIPLIER^2 smaller, than the capacity,...
-    if (stk->size <= (int)((float)stk->capacity / (2.0 * STACK_CAPACITY_MULTIPLIER)) 
-        && stk->size >= STACK_SIZE_DEFAULT)
-        increaseCapacity(stk, 1.0/STACK_CAPACITY_MULTIPLIER); //... decrease the capacity.
+    else if (stk->size <= stk->capacity / (STACK_CAPACITY_MULTIPLIER * STACK_CAPACITY_MULTIPLIER) 
+             && stk->size >= STACK_SIZE_DEFAULT && stk->spilledSize == 0)
+        changeCapacity(stk, roundCapacity(stk->capacity / STACK_CAPACITY_MULTIPLIER)); //... decrease the capacity.
 
+    *elem = stk->data[--stk->size];
     #ifndef RELEASE
     stk->data[stk->size] = POISON;
     #endif
-    *elem = stk->data[--stk->size];
+
+    // Start reading the next segment before the last one in memory runs out.
+    if (stk->spilledSize > 0 && stk->size <= STACK_SPILL_SEGMENT_SIZE)
+        spillPrefetch(stk->spill);
     
     UPDATE_HASH(stk);
+    releaseData(stk);
+    return NO_ERROR;
+}
+
+
+StackError stackEnableSpill(Stack* stk, size_t memoryBudget)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk       == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL,   DATA_NULL_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    stack_size_t spillCapacity = (stack_size_t)(memoryBudget / sizeof(elem_t));
+    spillCapacity -= spillCapacity % STACK_SPILL_SEGMENT_SIZE;
+    if (spillCapacity < 2 * STACK_SPILL_SEGMENT_SIZE)
+        spillCapacity = 2 * STACK_SPILL_SEGMENT_SIZE;
+
+    if (stk->spill == NULL)
+    {
+        StackError error = spillCtor(&stk->spill, STACK_SPILL_SEGMENT_SIZE);
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
+    stk->spillCapacity = spillCapacity;
+
+    while (stk->size >= stk->spillCapacity)
+    {
+        StackError error = spillBottomHalf(stk);
+        UPDATE_HASH(stk);
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
+    UPDATE_HASH(stk);
+
+    if (stk->capacity > stk->spillCapacity)
+    {
+        StackError error = changeCapacity(stk, stk->spillCapacity);
+        UPDATE_HASH(stk);
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
+
+    releaseData(stk);
     return NO_ERROR;
 }
 
@@ -327,31 +730,90 @@ inline static void freeData(Stack* stk)
     #endif
 }
 
+
+StackError stackFork_internal(Stack* stk, Stack* fork, StackInitInfo info)
+{
+    CHECK_CONDITION_RETURN_ERROR(stk  == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(fork == NULL, STRUCT_NULL_ERROR);
+    CHECK_CONDITION_RETURN_ERROR(stk->data == NULL, DATA_NULL_ERROR);
+
+    CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
+
+    CHECK_DUMP_AND_RETURN_ERROR(stk);
+
+    CHECK_DATA_HASH_RETURN_ERROR(stk);
+
+    CHECK_CONDITION_RETURN_ERROR(stk->spilledSize > 0, FORK_SPILLED_ERROR);
+
+    StackError error = stackInit_internal(fork, info);
+    DUMP_AND_RETURN_ERROR(stk, error);
+
+    if (stk->size > 0)
+    {
+        error = shareData(stk);
+        if (error != NO_ERROR)
+        {
+            freeData(fork);
+            budgetUnregister(fork->budget);
+        }
+        DUMP_AND_RETURN_ERROR(stk, error);
+    }
+
+    fork->base     = stk->base;
+    fork->baseSize = stk->baseSize;
+    if (fork->base != NULL)
+        fork->base->refCount++;
+
+    UPDATE_HASH(stk);
+    UPDATE_HASH(fork);
+    releaseData(stk);
+    releaseData(fork);
+
+    return NO_ERROR;
+}
+
+
 StackError stackDtor(Stack* stk)
 {
     CHECK_CONDITION_RETURN_ERROR(stk       == NULL, STRUCT_NULL_ERROR);
     CHECK_CONDITION_RETURN_ERROR(stk->data == NULL,   DATA_NULL_ERROR);
 
     CHECK_STACK_HASH_RETURN_ERROR(stk);
+
+    holdData(stk);
     
     CHECK_DUMP_AND_RETURN_ERROR(stk);
 
-    freeData(stk);
-
     CHECK_DATA_HASH_RETURN_ERROR(stk);
 
     #ifndef RELEASE
 
-    for (int i = 0; i < stk->capacity; i++)
+    for (stack_size_t i = 0; i < stk->capacity; i++)
     {
         stk->data[i] = POISON;
     }
 
     #endif
 
+    freeData(stk);
+    budgetUnregister(stk->budget);
+    stk->budget = NULL;
+
+    spillDtor(stk->spill);
+    stk->spill = NULL;
+
+    releaseShared(stk->base);
+    stk->base = NULL;
+
+    // Forks are destroyed one by one, so the log file is closed only once.
     if (stkerr != stderr)
     {
-        if (fclose(stkerr) != 0)
+        FILE* file = stkerr;
+        stkerr = stderr;
+
+        if (fclose(file) != 0)
             return CLOSING_FILE_ERROR;
     }
 
@@ -397,12 +859,17 @@ void stackDump_internal(const Stack* stk, const StackError err,
         printColor(red ,"\t *leftCanary:" CANARY_FORMAT "\n", stk->leftCanary);
     #endif
 
-    print("\t *size = %d      \n", stk->size);
-    print("\t *capacity = %d  \n", stk->capacity);
+    print("\t *size = " STACK_SIZE_FORMAT "      \n", stk->size);
+    print("\t *capacity = " STACK_SIZE_FORMAT "  \n", stk->capacity);
+    if (stk->spill != NULL)
+        print("\t *spilledSize = " STACK_SIZE_FORMAT "  \n", stk->spilledSize);
+    if (stk->base != NULL)
+        print("\t *base[%p] = " STACK_SIZE_FORMAT " shared elements\n", stk->base, stk->baseSize);
     print("\t *data[%p]:      \n", stk->data);
     
     
-    if (err != NEGATIVE_CAPACITY_ERROR && err != UNREGISTERED_STRUCT_ACCESS_ERROR && err != SIZE_CAPACITY_ERROR)
+    if (err != NEGATIVE_CAPACITY_ERROR && err != UNREGISTERED_STRUCT_ACCESS_ERROR && err != SIZE_CAPACITY_ERROR &&
+        err != STRUCT_MOVED_ERROR)
     {
         #ifdef CANARY_PROTECT
         canary_t leftCanary = *(canary_t*)((size_t)stk->data - sizeof(canary_t));
@@ -411,14 +878,14 @@ void stackDump_internal(const Stack* stk, const StackError err,
         else
             printColor(red ,"\t\t *leftCanary:" CANARY_FORMAT "\n", leftCanary);
         #endif
-        for (int i = 0; i < stk->capacity; i++)
+        for (stack_size_t i = 0; i < stk->capacity; i++)
         {
             // <(int)log10(stk->capacity) + 1> is the amount of digits in a number.
             if (i == stk->size)              printColor("blue", "%s", "\t\t> ");
             else if (stk->data[i] == POISON) print("\t\tO ");
             else                             print("\t\t@ ");
 
-            print("data[%.*d] = ", (int)log10(stk->capacity) + 1, i);
+            print("data[%.*lld] = ", (int)log10((double)stk->capacity) + 1, i);
             if (stk->data[i] == POISON) print("POISON");
             else                        print(ELEM_FORMAT, stk->data[i]);
 
@@ -445,7 +912,7 @@ void stackDump_internal(const Stack* stk, const StackError err,
 }
 
 
-static unsigned long long calculateHash(const char* dataStart, const size_t size)
+unsigned long long calculateHash(const char* dataStart, const size_t size)
 {
     assert(dataStart);
     unsigned long long hash = +79653421411ull; 
@@ -462,7 +929,8 @@ static unsigned long long calculateStackHash(const Stack* stk)
     assert(stk);
     unsigned long long hash = 0ull;
 
-    size_t stackSize = sizeof(&(stk->data)) + sizeof(stk->size) + sizeof(stk->capacity);
+    // Hash all the fields from data to info.
+    size_t stackSize = offsetof(Stack, info) - offsetof(Stack, data);
     hash += calculateHash((const char*)(&(stk->data)), stackSize);
 
     return hash;
@@ -474,7 +942,7 @@ static unsigned long long calculateDataHash(const Stack* stk)
     assert(stk);
     unsigned long long hash = 0ull;
 
-    hash += calculateHash((const char*)stk->data, stk->size * sizeof(elem_t));
+    hash += calculateHash((const char*)stk->data, (size_t)stk->size * sizeof(elem_t));
 
     return hash;
 }
@@ -490,3 +958,15 @@ StackError setLogFile(const char* fileName)
 
     return NO_ERROR;
 }
+
+
+FILE* getLogFile()
+{
+    return stkerr;
+}
+
+
+const char* getErrorString(StackError err)
+{
+    return ErrorString[err];
+}
@@ -0,0 +1,205 @@
+#include <mutex>
+#include "../include/stackBudget.h"
+
+
+// Guards the list of live stacks, the counters and the data of idle stacks.
+static std::mutex budgetMutex;
+
+static StackBudget* liveStacks = NULL;
+
+static size_t memoryUsage = 0;
+static size_t softLimit   = 0;
+static size_t hardLimit   = 0;
+
+static unsigned long long operationCount     = 0;
+static unsigned long long lastShrinkOperation = 0;
+
+
+/**
+ * @brief Records the new size of the stack data, the mutex has to be locked.
+*/
+static void commitBytes(StackBudget* budget, size_t bytes)
+{
+    memoryUsage = memoryUsage - budget->committed + bytes;
+    budget->committed = bytes;
+}
+
+
+/**
+ * @brief Shrinks the data of the idle stack to its idle size.
+ *
+ * @param[out] budget Memory accounting entry of the stack.
+*/
+static void shrinkData(StackBudget* budget)
+{
+    char* memory = (char*)realloc(budget->memory, budget->idleSize);
+    if (memory == NULL)
+        return;
+
+    #ifdef CANARY_PROTECT
+    *(canary_t*)(memory + budget->idleSize - sizeof(canary_t)) = CANARY_VALUE;
+    #endif
+
+    budget->memory = memory;
+    commitBytes(budget, budget->idleSize);
+}
+
+
+/**
+ * @brief Shrinks idle stacks until the memory usage drops to the target.
+ *
+ * @param[in] except Stack that is not shrunk.
+ * @param[in] target Memory usage to reach.
+*/
+static void shrinkIdleStacks(const StackBudget* except, size_t target)
+{
+    lastShrinkOperation = operationCount;
+
+    for (StackBudget* budget = liveStacks; budget != NULL && memoryUsage > target; budget = budget->next)
+    {
+        if (budget != except && !budget->pinned && budget->idleSize < budget->committed &&
+            operationCount - budget->lastUse >= STACK_IDLE_OPERATIONS)
+            shrinkData(budget);
+    }
+}
+
+
+StackBudget* budgetRegister(const void* owner)
+{
+    StackBudget* budget = (StackBudget*)calloc(1, sizeof(StackBudget));
+    if (budget == NULL)
+        return NULL;
+
+    budget->owner = owner;
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    budget->next    = liveStacks;
+    budget->lastUse = operationCount;
+
+    if (liveStacks != NULL)
+        liveStacks->prev = budget;
+    liveStacks = budget;
+
+    return budget;
+}
+
+
+void budgetUnregister(StackBudget* budget)
+{
+    if (budget == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(budgetMutex);
+
+        commitBytes(budget, 0);
+
+        if (budget->prev != NULL)
+            budget->prev->next = budget->next;
+        else
+            liveStacks = budget->next;
+
+        if (budget->next != NULL)
+            budget->next->prev = budget->prev;
+    }
+
+    free(budget);
+}
+
+
+bool budgetIsOwner(const StackBudget* budget, const void* owner)
+{
+    return budget != NULL && budget->owner == owner;
+}
+
+
+StackError budgetReserve(StackBudget* budget, size_t bytes)
+{
+    assert(budget);
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    if (bytes <= budget->committed)
+        return NO_ERROR;
+
+    size_t growth = bytes - budget->committed;
+
+    // Don't rescan the stacks on every push while staying above the soft limit.
+    if (softLimit != 0 && memoryUsage + growth > softLimit &&
+        operationCount - lastShrinkOperation >= STACK_IDLE_OPERATIONS)
+    {
+        shrinkIdleStacks(budget, softLimit > growth ? softLimit - growth : 0);
+    }
+
+    if (hardLimit != 0 && memoryUsage + growth > hardLimit)
+    {
+        shrinkIdleStacks(budget, hardLimit > growth ? hardLimit - growth : 0);
+
+        if (memoryUsage + growth > hardLimit)
+            return MEMORY_LIMIT_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+
+void budgetCommit(StackBudget* budget, void* memory, size_t bytes)
+{
+    assert(budget);
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    budget->memory   = (char*)memory;
+    budget->idleSize = bytes;
+    commitBytes(budget, bytes);
+}
+
+
+void budgetTouch(StackBudget* budget)
+{
+    assert(budget);
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    budget->lastUse  = ++operationCount;
+    budget->idleSize = budget->committed;
+    budget->pinned   = false;
+}
+
+
+void budgetRelease(StackBudget* budget, size_t idleSize)
+{
+    assert(budget);
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    budget->idleSize = idleSize < budget->committed ? idleSize : budget->committed;
+}
+
+
+void budgetPin(StackBudget* budget)
+{
+    assert(budget);
+
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    budget->pinned = true;
+}
+
+
+void setStackMemoryLimits(size_t soft, size_t hard)
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    softLimit = soft;
+    hardLimit = hard;
+}
+
+
+size_t getStackMemoryUsage()
+{
+    std::lock_guard<std::mutex> lock(budgetMutex);
+
+    return memoryUsage;
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include <sys/types.h>
+#include <new>
+#include <system_error>
+#include <thread>
+#include "../include/stackProtect.h"
+#include "../include/stackSpill.h"
+
+
+/**
+ * @brief Header of the segment record in the spill file.
+ *
+ * Record layout: header, `segmentSize` elements, right canary.
+*/
+struct SpillHeader
+{
+    #ifdef CANARY_PROTECT
+    canary_t leftCanary;
+    #endif
+
+    stack_size_t size; ///< Amount of elements in the segment.
+
+    #ifdef HASH_PROTECT
+    unsigned long long dataHash;
+    #endif
+};
+
+
+struct StackSpill
+{
+    FILE* file = NULL;                ///< Temporary file with the segments.
+    stack_size_t segmentSize = 0;     ///< Amount of elements in one segment.
+    stack_size_t segmentCount = 0;    ///< Amount of segments in the file.
+    size_t recordSize = 0;            ///< Size of one segment record in bytes.
+    char* buffer = NULL;              ///< Record read from the file.
+    std::thread prefetchThread = {};  ///< Thread reading the top record to the buffer.
+    stack_size_t bufferSegment = -1;  ///< Index of the segment in the buffer, -1 if none.
+};
+
+
+static bool seekRecord(StackSpill* spill, stack_size_t segment)
+{
+    off_t offset = (off_t)segment * (off_t)spill->recordSize;
+    return fseeko(spill->file, offset, SEEK_SET) == 0;
+}
+
+
+static void readRecord(StackSpill* spill, stack_size_t segment)
+{
+    if (seekRecord(spill, segment) && fread(spill->buffer, spill->recordSize, 1, spill->file) == 1)
+        spill->bufferSegment = segment;
+    else
+        spill->bufferSegment = -1;
+}
+
+
+static void waitPrefetch(StackSpill* spill)
+{
+    if (spill->prefetchThread.joinable())
+        spill->prefetchThread.join();
+}
+
+
+StackError spillCtor(StackSpill** spill, stack_size_t segmentSize)
+{
+    assert(spill);
+    assert(segmentSize > 0);
+
+    StackSpill* newSpill = new (std::nothrow) StackSpill;
+    if (newSpill == NULL)
+        return MEMORY_ALLOCATION_ERROR;
+
+    newSpill->segmentSize = segmentSize;
+    newSpill->recordSize  = sizeof(SpillHeader) + (size_t)segmentSize * sizeof(elem_t);
+    #ifdef CANARY_PROTECT
+    newSpill->recordSize += sizeof(canary_t);
+    #endif
+
+    newSpill->buffer = (char*)malloc(newSpill->recordSize);
+    if (newSpill->buffer == NULL)
+    {
+        delete newSpill;
+        return MEMORY_ALLOCATION_ERROR;
+    }
+
+    newSpill->file = tmpfile();
+    if (newSpill->file == NULL)
+    {
+        free(newSpill->buffer);
+        delete newSpill;
+        return OPENING_FILE_ERROR;
+    }
+
+    *spill = newSpill;
+    return NO_ERROR;
+}
+
+
+StackError spillWrite(StackSpill* spill, const elem_t* src)
+{
+    assert(spill);
+    assert(src);
+
+    // The prefetched segment is no longer the top one.
+    waitPrefetch(spill);
+    spill->bufferSegment = -1;
+
+    size_t dataSize = (size_t)spill->segmentSize * sizeof(elem_t);
+
+    SpillHeader header = {};
+    header.size = spill->segmentSize;
+    #ifdef CANARY_PROTECT
+    header.leftCanary = CANARY_VALUE;
+    #endif
+    #ifdef HASH_PROTECT
+    header.dataHash = calculateHash((const char*)src, dataSize);
+    #endif
+
+    if (!seekRecord(spill, spill->segmentCount))                 return SPILL_WRITE_ERROR;
+    if (fwrite(&header, sizeof(header), 1, spill->file) != 1)    return SPILL_WRITE_ERROR;
+    if (fwrite(src, dataSize, 1, spill->file) != 1)              return SPILL_WRITE_ERROR;
+    #ifdef CANARY_PROTECT
+    if (fwrite(&CANARY_VALUE, sizeof(canary_t), 1, spill->file) != 1) return SPILL_WRITE_ERROR;
+    #endif
+
+    spill->segmentCount++;
+    return NO_ERROR;
+}
+
+
+void spillPrefetch(StackSpill* spill)
+{
+    assert(spill);
+
+    stack_size_t top = spill->segmentCount - 1;
+    if (top < 0 || spill->prefetchThread.joinable() || spill->bufferSegment == top)
+        return;
+
+    // If the thread can't be started, spillRead reads the segment itself.
+    try
+    {
+        spill->prefetchThread = std::thread(readRecord, spill, top);
+    }
+    catch (const std::system_error&)
+    {
+    }
+}
+
+
+StackError spillRead(StackSpill* spill, elem_t* dst)
+{
+    assert(spill);
+    assert(dst);
+
+    stack_size_t top = spill->segmentCount - 1;
+    if (top < 0)
+        return POP_OUT_OF_RANGE_ERROR;
+
+    waitPrefetch(spill);
+    if (spill->bufferSegment != top)
+        readRecord(spill, top);
+    if (spill->bufferSegment != top)
+        return SPILL_READ_ERROR;
+
+    size_t dataSize = (size_t)spill->segmentSize * sizeof(elem_t);
+    const char* data = spill->buffer + sizeof(SpillHeader);
+
+    SpillHeader header = {};
+    memcpy(&header, spill->buffer, sizeof(header));
+
+    #ifdef CANARY_PROTECT
+    canary_t rightCanary = 0;
+    memcpy(&rightCanary, data + dataSize, sizeof(rightCanary));
+    if (header.leftCanary != CANARY_VALUE || rightCanary != CANARY_VALUE)
+        return DEAD_DATA_CANARY_ERROR;
+    #endif
+
+    if (header.size != spill->segmentSize)
+        return SPILL_READ_ERROR;
+
+    #ifdef HASH_PROTECT
+    if (header.dataHash != calculateHash(data, dataSize))
+        return UNREGISTERED_DATA_ACCESS_ERROR;
+    #endif
+
+    memcpy(dst, data, dataSize);
+
+    spill->bufferSegment = -1;
+    spill->segmentCount--;
+    return NO_ERROR;
+}
+
+
+void spillDtor(StackSpill* spill)
+{
+    if (spill == NULL)
+        return;
+
+    waitPrefetch(spill);
+    fclose(spill->file);
+    free(spill->buffer);
+    delete spill;
+}